@@ -0,0 +1,76 @@
+// Helpers installed into every sandbox created by evalcx. sum and stats
+// hand typed arrays to native versions, which evalcx installs as reduceSum
+// and reduceStats before running this script. Everything else, including
+// the plain arrays reduce functions get from CouchDB, is handled here.
+//
+// For typed arrays only the elements are summed. Unlike for plain arrays,
+// extra properties set on the array or inherited enumerable properties are
+// ignored.
+
+(function(global, nativeSum, nativeStats) {
+  delete global.reduceSum;
+  delete global.reduceStats;
+
+  function sum(values) {
+    if (ArrayBuffer.isView(values)) {
+      var total = nativeSum(values);
+      if (total !== undefined) {
+        return total;
+      }
+    }
+
+    var rv = 0;
+    for (var i in values) {
+      rv += values[i];
+    }
+    return rv;
+  }
+
+  function stats(values, rereduce) {
+    if (!rereduce && ArrayBuffer.isView(values)) {
+      var native = nativeStats(values);
+      if (native !== undefined) {
+        return native;
+      }
+    }
+
+    var result = null;
+    for (var i in values) {
+      var value = values[i];
+      if (!rereduce) {
+        if (typeof value != "number") {
+          throw {error: "invalid_value", reason: "stats() requires values to be numbers"};
+        }
+        value = {sum: value, count: 1, min: value, max: value, sumsqr: value * value};
+      }
+
+      if (result === null) {
+        result = {
+          sum: value.sum,
+          count: value.count,
+          min: value.min,
+          max: value.max,
+          sumsqr: value.sumsqr
+        };
+      } else {
+        result.sum += value.sum;
+        result.count += value.count;
+        result.min = Math.min(result.min, value.min);
+        result.max = Math.max(result.max, value.max);
+        result.sumsqr += value.sumsqr;
+      }
+    }
+    return result || {sum: 0, count: 0, min: 0, max: 0, sumsqr: 0};
+  }
+
+  function count(values, rereduce) {
+    if (rereduce) {
+      return sum(values);
+    }
+    return values.length;
+  }
+
+  global.sum = sum;
+  global.stats = stats;
+  global.count = count;
+})(this, reduceSum, reduceStats);
@@ -28,6 +28,7 @@ couch_parse_args(int argc, const char* argv[])
 
     memset(args, '\0', sizeof(couch_args));
     args->stack_size = 64L * 1024L * 1024L;
+    args->log_slots = 1024;
 
     while(i < argc) {
         if(strcmp("-h", argv[i]) == 0) {
@@ -50,10 +51,46 @@ couch_parse_args(int argc, const char* argv[])
                 fprintf(stderr, "Invalid stack size.\n");
                 exit(2);
             }
+        } else if(strcmp("--module-cache-size", argv[i]) == 0) {
+            args->module_cache_size = atoi(argv[++i]);
+            if(args->module_cache_size <= 0) {
+                fprintf(stderr, "Invalid module cache size.\n");
+                exit(2);
+            }
+        } else if(strcmp("--chunk-size", argv[i]) == 0) {
+            args->chunk_size = atoi(argv[++i]);
+            if(args->chunk_size <= 0) {
+                fprintf(stderr, "Invalid chunk size.\n");
+                exit(2);
+            }
+        } else if(strcmp("--log-slots", argv[i]) == 0) {
+            args->log_slots = atoi(argv[++i]);
+            if(args->log_slots <= 0) {
+                fprintf(stderr, "Invalid number of log slots.\n");
+                exit(2);
+            }
+        } else if(strcmp("--log-overwrite", argv[i]) == 0) {
+            args->log_overwrite = 1;
+        } else if(strcmp("--log-stderr", argv[i]) == 0) {
+            args->log_stderr = 1;
+        } else if(strcmp("--prelude", argv[i]) == 0) {
+            args->prelude = argv[++i];
         } else if(strcmp("-u", argv[i]) == 0) {
             args->uri_file = argv[++i];
         } else if(strcmp("--no-eval", argv[i]) == 0) {
             args->no_eval = 1;
+        } else if(strcmp("--no-jit", argv[i]) == 0) {
+            args->no_jit = 1;
+        } else if(strcmp("--no-background-jit", argv[i]) == 0) {
+            args->no_background_jit = 1;
+        } else if(strcmp("-E", argv[i]) == 0) {
+            args->eager = 1;
+        } else if(strcmp("--warmup", argv[i]) == 0) {
+            args->warmup = atoi(argv[++i]);
+            if(args->warmup < 0) {
+                fprintf(stderr, "Invalid warmup count.\n");
+                exit(2);
+            }
         } else if(strcmp("--", argv[i]) == 0) {
             i++;
             break;
@@ -18,13 +18,23 @@
 
 typedef struct {
     int          no_eval;
+    int          no_jit;
+    int          no_background_jit;
+    int          eager;
+    int          warmup;
     int          use_http;
     int          use_test_funs;
     int          use_legacy;
     int          debug;
     int          stack_size;
+    int          chunk_size;
+    int          module_cache_size;
+    int          log_slots;
+    int          log_overwrite;
+    int          log_stderr;
     const char** scripts;
     const char*  uri_file;
+    const char*  prelude;
 } couch_args;
 
 couch_args* couch_parse_args(int argc, const char* argv[]);
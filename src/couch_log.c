@@ -0,0 +1,279 @@
+// Licensed under the Apache License, Version 2.0 (the "License"); you may not
+// use this file except in compliance with the License. You may obtain a copy of
+// the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+// License for the specific language governing permissions and limitations under
+// the License.
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "couch_log.h"
+#include "couch_strbuf.h"
+
+// Batches are written once they grow larger than this.
+#define LOG_BATCH_BYTES 65536
+
+// Bounded multi-producer multi-consumer queue, see
+// http://www.1024cores.net/home/lock-free-algorithms/queues/bounded-mpmc-queue
+// The JS thread enqueues and, when overwriting, dequeues as well, the
+// writer thread dequeues.
+typedef struct {
+    size_t seq;
+    char* msg;
+    size_t len;
+} log_cell;
+
+static log_cell* cells = NULL;
+static size_t mask = 0;
+static size_t enqueue_pos = 0;
+static size_t dequeue_pos = 0;
+
+static FILE* out = NULL;
+static int log_flags = 0;
+static couch_log_stats stats = {0, 0, 0};
+
+// The writer sets sleeping before it waits on wakeup, and a producer that
+// sees it clears it and signals. Both flags are only changed while holding
+// wakeup_lock, so the writer never waits on a message it cannot see.
+static pthread_t writer;
+static pthread_mutex_t wakeup_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t wakeup = PTHREAD_COND_INITIALIZER;
+static int sleeping = 0;
+static int stopping = 0;
+
+static int log_enqueue(char* msg, size_t len);
+static int log_enqueue(char* msg, size_t len)
+{
+    size_t pos = __atomic_load_n(&enqueue_pos, __ATOMIC_RELAXED);
+    log_cell* cell;
+
+    for(;;) {
+        cell = &cells[pos & mask];
+        size_t seq = __atomic_load_n(&cell->seq, __ATOMIC_ACQUIRE);
+        intptr_t dif = (intptr_t) seq - (intptr_t) pos;
+        if(dif == 0) {
+            if(__atomic_compare_exchange_n(&enqueue_pos, &pos, pos + 1, 0,
+                    __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+                break;
+            }
+        } else if(dif < 0) {
+            return 0;
+        } else {
+            pos = __atomic_load_n(&enqueue_pos, __ATOMIC_RELAXED);
+        }
+    }
+
+    cell->msg = msg;
+    cell->len = len;
+    __atomic_store_n(&cell->seq, pos + 1, __ATOMIC_RELEASE);
+    return 1;
+}
+
+static int log_dequeue(char** msg, size_t* len);
+static int log_dequeue(char** msg, size_t* len)
+{
+    size_t pos = __atomic_load_n(&dequeue_pos, __ATOMIC_RELAXED);
+    log_cell* cell;
+
+    for(;;) {
+        cell = &cells[pos & mask];
+        size_t seq = __atomic_load_n(&cell->seq, __ATOMIC_ACQUIRE);
+        intptr_t dif = (intptr_t) seq - (intptr_t) (pos + 1);
+        if(dif == 0) {
+            if(__atomic_compare_exchange_n(&dequeue_pos, &pos, pos + 1, 0,
+                    __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+                break;
+            }
+        } else if(dif < 0) {
+            return 0;
+        } else {
+            pos = __atomic_load_n(&dequeue_pos, __ATOMIC_RELAXED);
+        }
+    }
+
+    *msg = cell->msg;
+    *len = cell->len;
+    __atomic_store_n(&cell->seq, pos + mask + 1, __ATOMIC_RELEASE);
+    return 1;
+}
+
+static int log_pending(void);
+static int log_pending(void)
+{
+    size_t pos = __atomic_load_n(&dequeue_pos, __ATOMIC_RELAXED);
+    size_t seq = __atomic_load_n(&cells[pos & mask].seq, __ATOMIC_ACQUIRE);
+    return seq == pos + 1;
+}
+
+static void log_format(couch_strbuf* batch, const char* msg, size_t len);
+static void log_format(couch_strbuf* batch, const char* msg, size_t len)
+{
+    if(log_flags & COUCH_LOG_RAW) {
+        couch_strbuf_append(batch, msg, len);
+        couch_strbuf_append(batch, "\n", 1);
+        return;
+    }
+
+    couch_strbuf_append(batch, "[\"log\",\"", 8);
+    couch_strbuf_append_json(batch, msg, len);
+    couch_strbuf_append(batch, "\"]\n", 3);
+}
+
+static void* log_writer(void* arg);
+static void* log_writer(void* arg)
+{
+    couch_strbuf batch = {NULL, 0, 0};
+    char* msg;
+    size_t len;
+
+    for(;;) {
+        size_t drained = 0;
+        couch_strbuf_reset(&batch);
+
+        while(batch.used < LOG_BATCH_BYTES && log_dequeue(&msg, &len)) {
+            log_format(&batch, msg, len);
+            free(msg);
+            drained++;
+        }
+
+        if(drained > 0) {
+            //a single fwrite keeps the batch from interleaving with
+            //protocol lines written by the JS thread
+            fwrite(batch.data, 1, batch.used, out);
+            fflush(out);
+            __atomic_add_fetch(&stats.written, drained, __ATOMIC_RELAXED);
+            continue;
+        }
+
+        pthread_mutex_lock(&wakeup_lock);
+        //publish sleeping before looking at the queue again, pairs with
+        //the fence in couch_log_write
+        __atomic_store_n(&sleeping, 1, __ATOMIC_SEQ_CST);
+        __atomic_thread_fence(__ATOMIC_SEQ_CST);
+        while(sleeping && !stopping && !log_pending()) {
+            pthread_cond_wait(&wakeup, &wakeup_lock);
+        }
+        __atomic_store_n(&sleeping, 0, __ATOMIC_RELAXED);
+        int stop = stopping && !log_pending();
+        pthread_mutex_unlock(&wakeup_lock);
+
+        if(stop) {
+            break;
+        }
+    }
+
+    couch_strbuf_free(&batch);
+    return NULL;
+}
+
+// The queue holds slots rounded up to a power of two, and at least 2.
+int couch_log_init(FILE* fp, size_t slots, int flags)
+{
+    size_t size = 2;
+    while(size < slots) {
+        size *= 2;
+    }
+
+    cells = (log_cell*) malloc(size * sizeof(log_cell));
+    if(cells == NULL) {
+        return 0;
+    }
+
+    for(size_t i = 0; i < size; i++) {
+        cells[i].seq = i;
+    }
+    mask = size - 1;
+    out = fp;
+    log_flags = flags;
+
+    if(pthread_create(&writer, NULL, log_writer, NULL) != 0) {
+        free(cells);
+        cells = NULL;
+        return 0;
+    }
+
+    atexit(couch_log_shutdown);
+    return 1;
+}
+
+// Called on the JS thread. Returns 0 if the message was dropped.
+int couch_log_write(const char* msg, size_t len)
+{
+    if(cells == NULL) {
+        return 0;
+    }
+
+    //an empty message still needs a non-NULL copy, `msg` may be NULL then
+    char* copy = (char*) malloc(len > 0 ? len : 1);
+    if(copy == NULL) {
+        __atomic_add_fetch(&stats.dropped, 1, __ATOMIC_RELAXED);
+        return 0;
+    }
+    if(len > 0) {
+        memcpy(copy, msg, len);
+    }
+
+    while(!log_enqueue(copy, len)) {
+        char* oldest;
+        size_t oldest_len;
+
+        if(!(log_flags & COUCH_LOG_OVERWRITE)) {
+            free(copy);
+            __atomic_add_fetch(&stats.dropped, 1, __ATOMIC_RELAXED);
+            return 0;
+        }
+
+        //make room by throwing away the oldest message, unless
+        //the writer got to it first
+        if(log_dequeue(&oldest, &oldest_len)) {
+            free(oldest);
+            __atomic_add_fetch(&stats.overwritten, 1, __ATOMIC_RELAXED);
+        }
+    }
+
+    //only take the lock when the writer is about to wait, so a burst of
+    //messages costs one wakeup
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    if(__atomic_load_n(&sleeping, __ATOMIC_RELAXED)) {
+        pthread_mutex_lock(&wakeup_lock);
+        __atomic_store_n(&sleeping, 0, __ATOMIC_RELAXED);
+        pthread_cond_signal(&wakeup);
+        pthread_mutex_unlock(&wakeup_lock);
+    }
+    return 1;
+}
+
+void couch_log_stats_get(couch_log_stats* result)
+{
+    result->written = __atomic_load_n(&stats.written, __ATOMIC_RELAXED);
+    result->dropped = __atomic_load_n(&stats.dropped, __ATOMIC_RELAXED);
+    result->overwritten = __atomic_load_n(&stats.overwritten, __ATOMIC_RELAXED);
+}
+
+// Writes out all queued messages and stops the writer thread.
+void couch_log_shutdown(void)
+{
+    if(cells == NULL) {
+        return;
+    }
+
+    pthread_mutex_lock(&wakeup_lock);
+    stopping = 1;
+    pthread_cond_signal(&wakeup);
+    pthread_mutex_unlock(&wakeup_lock);
+    pthread_join(writer, NULL);
+
+    free(cells);
+    cells = NULL;
+    stopping = 0;
+}
@@ -0,0 +1,39 @@
+// Licensed under the Apache License, Version 2.0 (the "License"); you may not
+// use this file except in compliance with the License. You may obtain a copy of
+// the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+// License for the specific language governing permissions and limitations under
+// the License.
+
+#ifndef COUCH_LOG
+#define COUCH_LOG
+
+#include <stdio.h>
+
+// Asynchronous sink for log() messages. Messages are copied into a bounded
+// lock-free queue and written by a background thread in batches, either as
+// ["log", message] protocol lines or, with COUCH_LOG_RAW, as plain lines.
+// When the queue is full a message is dropped or, with
+// COUCH_LOG_OVERWRITE, replaces the oldest queued message. The queue size
+// is rounded up to a power of two (at least 2).
+
+#define COUCH_LOG_OVERWRITE 1
+#define COUCH_LOG_RAW       2
+
+typedef struct {
+    size_t written;
+    size_t dropped;
+    size_t overwritten;
+} couch_log_stats;
+
+int couch_log_init(FILE* fp, size_t slots, int flags);
+int couch_log_write(const char* msg, size_t len);
+void couch_log_stats_get(couch_log_stats* stats);
+void couch_log_shutdown(void);
+
+#endif
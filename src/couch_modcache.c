@@ -0,0 +1,299 @@
+// Licensed under the Apache License, Version 2.0 (the "License"); you may not
+// use this file except in compliance with the License. You may obtain a copy of
+// the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+// License for the specific language governing permissions and limitations under
+// the License.
+
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <ChakraCore.h>
+
+#include "couch_modcache.h"
+
+typedef struct modcache_ddoc {
+    char* id;
+    char* rev;
+    size_t modules;
+    size_t last_used;
+    struct modcache_ddoc* next;
+} modcache_ddoc;
+
+typedef struct modcache_entry {
+    modcache_ddoc* ddoc;
+    JsContextRef context;
+    char* path;
+    size_t hash;
+    JsValueRef exports;
+    struct modcache_entry* next;
+} modcache_entry;
+
+static modcache_ddoc* ddocs = NULL;
+static modcache_entry** buckets = NULL;
+static size_t nbuckets = 0;
+static size_t max_size = 1024;
+static size_t use_clock = 0;
+static couch_modcache_stats stats = {0, 0, 0};
+
+static char* modcache_strdup(const char* str);
+static char* modcache_strdup(const char* str)
+{
+    size_t len = strlen(str) + 1;
+    char* copy = (char*) malloc(len);
+    if(copy) memcpy(copy, str, len);
+    return copy;
+}
+
+static size_t modcache_hash(JsContextRef context, const char* id, const char* path);
+static size_t modcache_hash(JsContextRef context, const char* id, const char* path)
+{
+    // FNV-1a over "id\0path", seeded with the context
+    size_t h = 2166136261u ^ (size_t) context;
+    for(; *id; id++) {
+        h = (h ^ (unsigned char) *id) * 16777619u;
+    }
+    h = h * 16777619u;
+    for(; *path; path++) {
+        h = (h ^ (unsigned char) *path) * 16777619u;
+    }
+    return h;
+}
+
+static void modcache_free(modcache_entry* entry);
+static void modcache_free(modcache_entry* entry)
+{
+    JsRelease(entry->exports, NULL);
+    entry->ddoc->modules--;
+    free(entry->path);
+    free(entry);
+    stats.size--;
+}
+
+static int modcache_grow(void);
+static int modcache_grow(void)
+{
+    size_t size = nbuckets ? nbuckets * 2 : 64;
+    modcache_entry** tmp = (modcache_entry**) calloc(size, sizeof(modcache_entry*));
+    if(tmp == NULL) return 0;
+
+    for(size_t i = 0; i < nbuckets; i++) {
+        modcache_entry* entry = buckets[i];
+        while(entry) {
+            modcache_entry* next = entry->next;
+            entry->next = tmp[entry->hash & (size - 1)];
+            tmp[entry->hash & (size - 1)] = entry;
+            entry = next;
+        }
+    }
+
+    free(buckets);
+    buckets = tmp;
+    nbuckets = size;
+    return 1;
+}
+
+// Drops all modules of `ddoc`. Only happens when its rev changes or it gets
+// evicted, so walking all buckets is fine.
+static void modcache_drop(modcache_ddoc* ddoc);
+static void modcache_drop(modcache_ddoc* ddoc)
+{
+    for(size_t i = 0; i < nbuckets && ddoc->modules > 0; i++) {
+        modcache_entry** link = &buckets[i];
+        while(*link) {
+            modcache_entry* entry = *link;
+            if(entry->ddoc == ddoc) {
+                *link = entry->next;
+                modcache_free(entry);
+            } else {
+                link = &entry->next;
+            }
+        }
+    }
+}
+
+// Returns the record of design doc `id`, with the modules of an older rev
+// dropped. If `create` is set a missing record gets created.
+static modcache_ddoc* modcache_ddoc_get(const char* id, const char* rev, int create);
+static modcache_ddoc* modcache_ddoc_get(const char* id, const char* rev, int create)
+{
+    modcache_ddoc* ddoc = ddocs;
+    for(; ddoc; ddoc = ddoc->next) {
+        if(strcmp(ddoc->id, id) == 0) break;
+    }
+
+    if(ddoc && strcmp(ddoc->rev, rev) != 0) {
+        // The design doc was updated, none of its modules are valid anymore.
+        char* newRev = modcache_strdup(rev);
+        if(newRev == NULL) return NULL;
+        modcache_drop(ddoc);
+        free(ddoc->rev);
+        ddoc->rev = newRev;
+    }
+
+    if(!ddoc && create) {
+        ddoc = (modcache_ddoc*) calloc(1, sizeof(modcache_ddoc));
+        if(ddoc == NULL) return NULL;
+        ddoc->id = modcache_strdup(id);
+        ddoc->rev = modcache_strdup(rev);
+        if(!ddoc->id || !ddoc->rev) {
+            free(ddoc->id);
+            free(ddoc->rev);
+            free(ddoc);
+            return NULL;
+        }
+        ddoc->next = ddocs;
+        ddocs = ddoc;
+    }
+
+    if(ddoc) {
+        ddoc->last_used = ++use_clock;
+    }
+    return ddoc;
+}
+
+// Drops the modules of the least recently used design doc other than `keep`.
+static void modcache_evict(modcache_ddoc* keep);
+static void modcache_evict(modcache_ddoc* keep)
+{
+    modcache_ddoc** link = &ddocs;
+    modcache_ddoc** lru = NULL;
+
+    for(; *link; link = &(*link)->next) {
+        if(*link != keep && (lru == NULL || (*link)->last_used < (*lru)->last_used)) {
+            lru = link;
+        }
+    }
+
+    if(lru) {
+        modcache_ddoc* ddoc = *lru;
+        modcache_drop(ddoc);
+        *lru = ddoc->next;
+        free(ddoc->id);
+        free(ddoc->rev);
+        free(ddoc);
+    }
+}
+
+static modcache_entry* modcache_find(modcache_ddoc* ddoc, JsContextRef context, const char* path, size_t hash);
+static modcache_entry* modcache_find(modcache_ddoc* ddoc, JsContextRef context, const char* path, size_t hash)
+{
+    if(nbuckets == 0) return NULL;
+
+    modcache_entry* entry = buckets[hash & (nbuckets - 1)];
+    for(; entry; entry = entry->next) {
+        if(entry->hash == hash
+            && entry->ddoc == ddoc
+            && entry->context == context
+            && strcmp(entry->path, path) == 0) {
+            return entry;
+        }
+    }
+    return NULL;
+}
+
+void couch_modcache_init(size_t max_modules)
+{
+    if(max_modules > 0) {
+        max_size = max_modules;
+    }
+}
+
+JsValueRef couch_modcache_get(JsContextRef context, const char* id, const char* rev, const char* path)
+{
+    modcache_ddoc* ddoc = modcache_ddoc_get(id, rev, 0);
+    modcache_entry* entry = NULL;
+
+    if(ddoc) {
+        entry = modcache_find(ddoc, context, path, modcache_hash(context, id, path));
+    }
+
+    if(!entry) {
+        stats.misses++;
+        return JS_INVALID_REFERENCE;
+    }
+
+    stats.hits++;
+    return entry->exports;
+}
+
+void couch_modcache_put(JsContextRef context, const char* id, const char* rev, const char* path, JsValueRef exports)
+{
+    size_t hash = modcache_hash(context, id, path);
+    modcache_ddoc* ddoc = modcache_ddoc_get(id, rev, 1);
+    modcache_entry* entry;
+
+    if(ddoc == NULL) return;
+
+    entry = modcache_find(ddoc, context, path, hash);
+    if(entry) {
+        JsAddRef(exports, NULL);
+        JsRelease(entry->exports, NULL);
+        entry->exports = exports;
+        return;
+    }
+
+    while(stats.size >= max_size && ddocs->next) {
+        modcache_evict(ddoc);
+    }
+
+    if(stats.size >= nbuckets && !modcache_grow()) {
+        return;
+    }
+
+    entry = (modcache_entry*) malloc(sizeof(modcache_entry));
+    if(entry == NULL) return;
+
+    entry->path = modcache_strdup(path);
+    if(!entry->path) {
+        free(entry);
+        return;
+    }
+
+    //The exports keep their sandbox context alive for as long as
+    //they are cached, so `context` can't be reused by another sandbox.
+    //The corresponding JsRelease is done in modcache_free()
+    JsAddRef(exports, NULL);
+    entry->exports = exports;
+    entry->context = context;
+    entry->ddoc = ddoc;
+    entry->hash = hash;
+    entry->next = buckets[hash & (nbuckets - 1)];
+    buckets[hash & (nbuckets - 1)] = entry;
+    ddoc->modules++;
+    stats.size++;
+}
+
+void couch_modcache_stats_get(couch_modcache_stats* out)
+{
+    *out = stats;
+}
+
+void couch_modcache_clear(void)
+{
+    for(size_t i = 0; i < nbuckets; i++) {
+        modcache_entry* entry = buckets[i];
+        while(entry) {
+            modcache_entry* next = entry->next;
+            modcache_free(entry);
+            entry = next;
+        }
+    }
+    free(buckets);
+    buckets = NULL;
+    nbuckets = 0;
+
+    while(ddocs) {
+        modcache_ddoc* next = ddocs->next;
+        free(ddocs->id);
+        free(ddocs->rev);
+        free(ddocs);
+        ddocs = next;
+    }
+}
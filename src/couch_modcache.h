@@ -0,0 +1,44 @@
+// Licensed under the Apache License, Version 2.0 (the "License"); you may not
+// use this file except in compliance with the License. You may obtain a copy of
+// the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+// License for the specific language governing permissions and limitations under
+// the License.
+
+#ifndef COUCH_MODCACHE
+#define COUCH_MODCACHE
+
+#include <stddef.h>
+
+#ifndef _CHAKRACORE_H_ 
+typedef void* JsValueRef;
+typedef void* JsContextRef;
+#endif
+
+// Registry of evaluated CommonJS module exports, keyed by the sandbox context
+// they were evaluated in, design doc id, design doc rev and module path.
+// Exports are only handed out to the sandbox they belong to, so functions
+// compiled into different sandboxes never share module objects or state.
+// Each design doc remembers the rev its modules were
+// stored under, looking up or storing a module with a different rev drops
+// the modules of that design doc. Once more than `max_modules` modules are
+// cached, the modules of the least recently used design doc are dropped.
+
+typedef struct {
+    size_t size;
+    size_t hits;
+    size_t misses;
+} couch_modcache_stats;
+
+void couch_modcache_init(size_t max_modules);
+JsValueRef couch_modcache_get(JsContextRef context, const char* id, const char* rev, const char* path);
+void couch_modcache_put(JsContextRef context, const char* id, const char* rev, const char* path, JsValueRef exports);
+void couch_modcache_stats_get(couch_modcache_stats* stats);
+void couch_modcache_clear(void);
+
+#endif
@@ -12,7 +12,30 @@
 
 #include <stdlib.h>
 
+#include <ChakraCore.h>
+
 #include "couch_readline.h"
+
+// Number of line buffers kept for reuse once their ArrayBuffer got collected.
+#define LINEBUF_POOL_SIZE 4
+// Buffers growing larger than this are freed instead of being pooled, so a
+// short line never pins more than this.
+#define LINEBUF_POOL_MAX_BYTES (64 * 1024)
+// The GC doesn't know about the memory behind external ArrayBuffers. Once
+// this much of it is handed out, lines are copied into regular ArrayBuffers,
+// which the GC accounts for, until some external ones got collected.
+#define LINEBUF_EXTERNAL_MAX_BYTES (32 * 1024 * 1024)
+
+typedef struct {
+    char* data;
+    size_t size;
+    size_t external;
+} linebuf;
+
+static linebuf* linebuf_pool[LINEBUF_POOL_SIZE];
+static int linebuf_pooled = 0;
+static size_t linebuf_external = 0;
+
 int couch_fgets(char* buf, int size, FILE* fp);
 int couch_fgets(char* buf, int size, FILE* fp)
 {
@@ -79,3 +102,109 @@ JsValueRef couch_readline(FILE* fp)
     return str;
 }
 
+static linebuf* linebuf_acquire(void);
+static linebuf* linebuf_acquire(void)
+{
+    if(linebuf_pooled > 0) {
+        return linebuf_pool[--linebuf_pooled];
+    }
+
+    linebuf* buf = (linebuf*) malloc(sizeof(linebuf));
+    if(buf == NULL) return NULL;
+
+    buf->size = 256;
+    buf->external = 0;
+    buf->data = (char*) malloc(buf->size * sizeof(char));
+    if(buf->data == NULL) {
+        free(buf);
+        return NULL;
+    }
+    return buf;
+}
+
+static void linebuf_release(void* data);
+static void linebuf_release(void* data)
+{
+    linebuf* buf = (linebuf*) data;
+
+    linebuf_external -= buf->external;
+    buf->external = 0;
+
+    if(linebuf_pooled < LINEBUF_POOL_SIZE && buf->size <= LINEBUF_POOL_MAX_BYTES) {
+        linebuf_pool[linebuf_pooled++] = buf;
+        return;
+    }
+
+    free(buf->data);
+    free(buf);
+}
+
+// Copies the line into an ArrayBuffer owned by the GC.
+static JsValueRef linebuf_copy(linebuf* buf, size_t used);
+static JsValueRef linebuf_copy(linebuf* buf, size_t used)
+{
+    JsValueRef arrayBuffer;
+    unsigned char* storage;
+    unsigned int storageLength;
+
+    if(JsCreateArrayBuffer((unsigned int) used, &arrayBuffer) != JsNoError
+        || JsGetArrayBufferStorage(arrayBuffer, &storage, &storageLength) != JsNoError) {
+        linebuf_release(buf);
+        return NULL;
+    }
+
+    memcpy(storage, buf->data, used);
+    linebuf_release(buf);
+    return arrayBuffer;
+}
+
+JsValueRef couch_readline_buffer(FILE* fp)
+{
+    char* tmp = NULL;
+    size_t used = 0;
+    size_t readlen = 0;
+
+    linebuf* buf = linebuf_acquire();
+    if(buf == NULL) return NULL;
+
+    while((readlen = couch_fgets(buf->data+used, buf->size-used, fp)) > 0) {
+        used += readlen;
+
+        if(buf->data[used-1] == '\n') {
+            used--;
+            break;
+        }
+
+        // Double our buffer and read more.
+        tmp = realloc(buf->data, buf->size * 2 * sizeof(char));
+        if(!tmp) {
+            linebuf_release(buf);
+            return NULL;
+        }
+
+        buf->data = tmp;
+        buf->size *= 2;
+    }
+
+    if(used == 0 && readlen == 0 && feof(fp)) {
+        linebuf_release(buf);
+        return NULL;
+    }
+
+    if(linebuf_external + buf->size > LINEBUF_EXTERNAL_MAX_BYTES) {
+        return linebuf_copy(buf, used);
+    }
+
+    //The buffer goes back to the pool in linebuf_release() once
+    //the ArrayBuffer is garbage collected.
+    JsValueRef arrayBuffer;
+    if(JsCreateExternalArrayBuffer(buf->data, (unsigned int) used,
+            linebuf_release, buf, &arrayBuffer) != JsNoError) {
+        linebuf_release(buf);
+        return NULL;
+    }
+
+    buf->external = buf->size;
+    linebuf_external += buf->size;
+    return arrayBuffer;
+}
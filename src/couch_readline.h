@@ -22,4 +22,8 @@ typedef void* JsValueRef;
 #endif
 
 JsValueRef couch_readline(FILE* fp);
+
+// Like couch_readline() but returns the line, without the trailing newline,
+// as an external ArrayBuffer pointing into a recycled native buffer.
+JsValueRef couch_readline_buffer(FILE* fp);
 #endif
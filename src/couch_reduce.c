@@ -0,0 +1,113 @@
+// Licensed under the Apache License, Version 2.0 (the "License"); you may not
+// use this file except in compliance with the License. You may obtain a copy of
+// the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+// License for the specific language governing permissions and limitations under
+// the License.
+
+#include <stdint.h>
+
+#include "couch_reduce.h"
+
+#define SUM_LANES 8
+
+// Sums `count` integers of type `type` found at `data` into an int64_t.
+#define SUM_INTEGERS(type, data, count, out)                 \
+    do {                                                     \
+        const type* values = (const type*) (data);           \
+        int64_t lanes[SUM_LANES] = {0};                      \
+        size_t i = 0;                                        \
+        for(; i + SUM_LANES <= (count); i += SUM_LANES) {    \
+            for(int l = 0; l < SUM_LANES; l++) {             \
+                lanes[l] += values[i + l];                   \
+            }                                                \
+        }                                                    \
+        for(; i < (count); i++) {                            \
+            lanes[0] += values[i];                           \
+        }                                                    \
+        int64_t total = 0;                                   \
+        for(int l = 0; l < SUM_LANES; l++) {                 \
+            total += lanes[l];                               \
+        }                                                    \
+        (out) = (double) total;                              \
+    } while(0)
+
+// Sums `count` floating point values in array order.
+#define SUM_FLOATS(type, data, count, out)                   \
+    do {                                                     \
+        const type* values = (const type*) (data);           \
+        double total = 0;                                    \
+        for(size_t i = 0; i < (count); i++) {                \
+            total += values[i];                              \
+        }                                                    \
+        (out) = total;                                       \
+    } while(0)
+
+#define STATS_VALUES(type, data, count, stats)               \
+    do {                                                     \
+        const type* values = (const type*) (data);           \
+        for(size_t i = 0; i < (count); i++) {                \
+            couch_reduce_stats_add((stats), values[i]);      \
+        }                                                    \
+    } while(0)
+
+void couch_reduce_stats_add(couch_reduce_stats* stats, double value)
+{
+    if(stats->count == 0) {
+        stats->sum = value;
+        stats->min = value;
+        stats->max = value;
+        stats->sumsqr = value * value;
+    } else {
+        stats->sum += value;
+        if(value < stats->min) stats->min = value;
+        if(value > stats->max) stats->max = value;
+        stats->sumsqr += value * value;
+    }
+    stats->count++;
+}
+
+// Returns 0 if `type` isn't supported.
+int couch_reduce_sum_typed(const void* data, size_t count, JsTypedArrayType type, double* sum)
+{
+    switch(type) {
+        case JsArrayTypeInt8:         SUM_INTEGERS(int8_t, data, count, *sum);   break;
+        case JsArrayTypeUint8:
+        case JsArrayTypeUint8Clamped: SUM_INTEGERS(uint8_t, data, count, *sum);  break;
+        case JsArrayTypeInt16:        SUM_INTEGERS(int16_t, data, count, *sum);  break;
+        case JsArrayTypeUint16:       SUM_INTEGERS(uint16_t, data, count, *sum); break;
+        case JsArrayTypeInt32:        SUM_INTEGERS(int32_t, data, count, *sum);  break;
+        case JsArrayTypeUint32:       SUM_INTEGERS(uint32_t, data, count, *sum); break;
+        case JsArrayTypeFloat32:      SUM_FLOATS(float, data, count, *sum);      break;
+        case JsArrayTypeFloat64:      SUM_FLOATS(double, data, count, *sum);     break;
+        default:
+            return 0;
+    }
+    return 1;
+}
+
+// Returns 0 if `type` isn't supported. NaN values are added as is, callers
+// wanting JavaScript's Math.min/Math.max semantics have to check whether
+// the resulting sum is NaN.
+int couch_reduce_stats_typed(const void* data, size_t count, JsTypedArrayType type, couch_reduce_stats* stats)
+{
+    switch(type) {
+        case JsArrayTypeInt8:         STATS_VALUES(int8_t, data, count, stats);   break;
+        case JsArrayTypeUint8:
+        case JsArrayTypeUint8Clamped: STATS_VALUES(uint8_t, data, count, stats);  break;
+        case JsArrayTypeInt16:        STATS_VALUES(int16_t, data, count, stats);  break;
+        case JsArrayTypeUint16:       STATS_VALUES(uint16_t, data, count, stats); break;
+        case JsArrayTypeInt32:        STATS_VALUES(int32_t, data, count, stats);  break;
+        case JsArrayTypeUint32:       STATS_VALUES(uint32_t, data, count, stats); break;
+        case JsArrayTypeFloat32:      STATS_VALUES(float, data, count, stats);    break;
+        case JsArrayTypeFloat64:      STATS_VALUES(double, data, count, stats);   break;
+        default:
+            return 0;
+    }
+    return 1;
+}
@@ -0,0 +1,38 @@
+// Licensed under the Apache License, Version 2.0 (the "License"); you may not
+// use this file except in compliance with the License. You may obtain a copy of
+// the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+// License for the specific language governing permissions and limitations under
+// the License.
+
+#ifndef COUCH_REDUCE
+#define COUCH_REDUCE
+
+#include <stddef.h>
+
+#include <ChakraCore.h>
+
+// Numeric kernels behind the native sum() and stats() sandbox builtins,
+// which use them for typed arrays. Doubles are accumulated in array order
+// so results are identical to the JavaScript versions in js/builtins.js.
+// Integer typed arrays are summed in several independent lanes, which is
+// exact and lets the compiler vectorize the loop.
+
+typedef struct {
+    double sum;
+    double count;
+    double min;
+    double max;
+    double sumsqr;
+} couch_reduce_stats;
+
+void couch_reduce_stats_add(couch_reduce_stats* stats, double value);
+int couch_reduce_sum_typed(const void* data, size_t count, JsTypedArrayType type, double* sum);
+int couch_reduce_stats_typed(const void* data, size_t count, JsTypedArrayType type, couch_reduce_stats* stats);
+
+#endif
@@ -0,0 +1,123 @@
+// Licensed under the Apache License, Version 2.0 (the "License"); you may not
+// use this file except in compliance with the License. You may obtain a copy of
+// the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+// License for the specific language governing permissions and limitations under
+// the License.
+
+#include <string.h>
+
+#include "couch_sendbuf.h"
+#include "couch_strbuf.h"
+
+// The escaped chunks, separated by commas, e.g. `"foo","bar`
+static couch_strbuf chunks = {NULL, 0, 0};
+// The message written on flush.
+static couch_strbuf message = {NULL, 0, 0};
+
+static size_t max_chunk_size = 65536;
+static size_t chunk_used = 0;
+static int chunk_open = 0;
+
+void couch_sendbuf_init(size_t chunk_size)
+{
+    if(chunk_size > 0) {
+        max_chunk_size = chunk_size;
+    }
+}
+
+int couch_sendbuf_send(const char* chunk, size_t len)
+{
+    while(len > 0) {
+        size_t room;
+        size_t n;
+
+        if(chunk_open && chunk_used >= max_chunk_size) {
+            chunk_open = 0;
+        }
+
+        if(!chunk_open) {
+            if(chunks.used > 0 && !couch_strbuf_append(&chunks, "\",\"", 3)) {
+                return 0;
+            }
+            chunk_open = 1;
+            chunk_used = 0;
+        }
+
+        room = max_chunk_size - chunk_used;
+        n = len < room ? len : room;
+
+        // Don't split UTF-8 sequences between chunks.
+        while(n < len && n > 0 && (chunk[n] & 0xC0) == 0x80) {
+            n--;
+        }
+        if(n == 0) {
+            if(chunk_used > 0) {
+                // Not even the next character fits, start a new chunk.
+                chunk_open = 0;
+                continue;
+            }
+            // SIZE is smaller than a single character.
+            n = 1;
+            while(n < len && (chunk[n] & 0xC0) == 0x80) {
+                n++;
+            }
+        }
+
+        if(!couch_strbuf_append_json(&chunks, chunk, n)) {
+            return 0;
+        }
+
+        chunk_used += n;
+        chunk += n;
+        len -= n;
+    }
+    return 1;
+}
+
+// Writes ["label",[chunks...]] or, if `extra` isn't NULL,
+// ["label",[chunks...],extra] followed by a newline. `extra` has to be
+// valid JSON.
+int couch_sendbuf_flush(FILE* fp, const char* label, const char* extra)
+{
+    int ok = 1;
+
+    couch_strbuf_reset(&message);
+
+    ok = ok && couch_strbuf_append(&message, "[\"", 2);
+    ok = ok && couch_strbuf_append_json(&message, label, strlen(label));
+    ok = ok && couch_strbuf_append(&message, "\",[", 3);
+    if(chunks.used > 0) {
+        ok = ok && couch_strbuf_append(&message, "\"", 1);
+        ok = ok && couch_strbuf_append(&message, chunks.data, chunks.used);
+        ok = ok && couch_strbuf_append(&message, "\"", 1);
+    }
+    ok = ok && couch_strbuf_append(&message, "]", 1);
+    if(extra) {
+        ok = ok && couch_strbuf_append(&message, ",", 1);
+        ok = ok && couch_strbuf_append(&message, extra, strlen(extra));
+    }
+    ok = ok && couch_strbuf_append(&message, "]\n", 2);
+
+    couch_strbuf_reset(&chunks);
+    chunk_open = 0;
+
+    if(!ok) {
+        return 0;
+    }
+
+    fwrite(message.data, 1, message.used, fp);
+    fflush(fp);
+    return 1;
+}
+
+void couch_sendbuf_free(void)
+{
+    couch_strbuf_free(&chunks);
+    couch_strbuf_free(&message);
+}
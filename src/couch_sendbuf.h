@@ -0,0 +1,29 @@
+// Licensed under the Apache License, Version 2.0 (the "License"); you may not
+// use this file except in compliance with the License. You may obtain a copy of
+// the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+// License for the specific language governing permissions and limitations under
+// the License.
+
+#ifndef COUCH_SENDBUF
+#define COUCH_SENDBUF
+
+#include <stdio.h>
+
+// Accumulates the chunks passed to send() by list and show functions.
+// Consecutive chunks are coalesced into chunks of at most `chunk_size`
+// bytes, larger ones are split at UTF-8 character boundaries. They are
+// written as one ["label", [chunks...]] protocol message by
+// couch_sendbuf_flush(). The buffers are kept across flushes.
+
+void couch_sendbuf_init(size_t chunk_size);
+int couch_sendbuf_send(const char* chunk, size_t len);
+int couch_sendbuf_flush(FILE* fp, const char* label, const char* extra);
+void couch_sendbuf_free(void);
+
+#endif
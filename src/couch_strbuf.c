@@ -0,0 +1,106 @@
+// Licensed under the Apache License, Version 2.0 (the "License"); you may not
+// use this file except in compliance with the License. You may obtain a copy of
+// the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+// License for the specific language governing permissions and limitations under
+// the License.
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "couch_strbuf.h"
+
+// Makes sure there's room for at least `len` more bytes.
+int couch_strbuf_reserve(couch_strbuf* buf, size_t len)
+{
+    char* tmp;
+    size_t size;
+
+    if(buf->used + len <= buf->size) {
+        return 1;
+    }
+
+    size = buf->size ? buf->size : 256;
+    while(size < buf->used + len) {
+        // Double our buffer.
+        size *= 2;
+    }
+
+    tmp = realloc(buf->data, size);
+    if(!tmp) {
+        return 0;
+    }
+
+    buf->data = tmp;
+    buf->size = size;
+    return 1;
+}
+
+int couch_strbuf_append(couch_strbuf* buf, const char* str, size_t len)
+{
+    if(!couch_strbuf_reserve(buf, len)) {
+        return 0;
+    }
+
+    memcpy(buf->data + buf->used, str, len);
+    buf->used += len;
+    return 1;
+}
+
+// Appends `str` escaped as the contents of a JSON string, without the
+// surrounding quotes. `str` is expected to be UTF-8.
+int couch_strbuf_append_json(couch_strbuf* buf, const char* str, size_t len)
+{
+    static const char hex[] = "0123456789abcdef";
+
+    // Worst case every byte expands to \u00XX.
+    if(!couch_strbuf_reserve(buf, len * 6)) {
+        return 0;
+    }
+
+    char* out = buf->data + buf->used;
+    for(size_t i = 0; i < len; i++) {
+        unsigned char c = (unsigned char) str[i];
+        switch(c) {
+            case '"':  *out++ = '\\'; *out++ = '"';  break;
+            case '\\': *out++ = '\\'; *out++ = '\\'; break;
+            case '\n': *out++ = '\\'; *out++ = 'n';  break;
+            case '\r': *out++ = '\\'; *out++ = 'r';  break;
+            case '\t': *out++ = '\\'; *out++ = 't';  break;
+            case '\b': *out++ = '\\'; *out++ = 'b';  break;
+            case '\f': *out++ = '\\'; *out++ = 'f';  break;
+            default:
+                if(c < 0x20) {
+                    *out++ = '\\';
+                    *out++ = 'u';
+                    *out++ = '0';
+                    *out++ = '0';
+                    *out++ = hex[c >> 4];
+                    *out++ = hex[c & 0xf];
+                } else {
+                    *out++ = c;
+                }
+        }
+    }
+
+    buf->used = out - buf->data;
+    return 1;
+}
+
+void couch_strbuf_reset(couch_strbuf* buf)
+{
+    buf->used = 0;
+}
+
+void couch_strbuf_free(couch_strbuf* buf)
+{
+    free(buf->data);
+    buf->data = NULL;
+    buf->used = 0;
+    buf->size = 0;
+}
@@ -0,0 +1,32 @@
+// Licensed under the Apache License, Version 2.0 (the "License"); you may not
+// use this file except in compliance with the License. You may obtain a copy of
+// the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+// License for the specific language governing permissions and limitations under
+// the License.
+
+#ifndef COUCH_STRBUF
+#define COUCH_STRBUF
+
+#include <stddef.h>
+
+// Growable byte buffer. Resetting keeps the allocated memory around so a
+// buffer can be reused without reallocating.
+typedef struct {
+    char*  data;
+    size_t used;
+    size_t size;
+} couch_strbuf;
+
+int couch_strbuf_reserve(couch_strbuf* buf, size_t len);
+int couch_strbuf_append(couch_strbuf* buf, const char* str, size_t len);
+int couch_strbuf_append_json(couch_strbuf* buf, const char* str, size_t len);
+void couch_strbuf_reset(couch_strbuf* buf);
+void couch_strbuf_free(couch_strbuf* buf);
+
+#endif
@@ -56,11 +56,41 @@ static const char USAGE_TEMPLATE[] =
     "              NOT IMPLEMENTED\n"
     "  -S SIZE     specify that the runtime should allow at\n"
     "              most SIZE bytes of memory to be allocated\n"
+    "  --prelude FILE\n"
+    "              run FILE in every sandbox created with evalcx,\n"
+    "              it is only compiled once\n"
     "  -u FILE     path to a .uri file containing the address\n"
     "              (or addresses) of one or more servers\n"
     "              NOT IMPLEMENTED\n"
+    "  --module-cache-size N\n"
+    "              cache the exports of at most N CommonJS modules,\n"
+    "              the modules of the least recently used design doc\n"
+    "              are dropped first (default 1024)\n"
+    "  --chunk-size SIZE\n"
+    "              coalesce chunks passed to send() into chunks\n"
+    "              of at most SIZE bytes, larger ones are split\n"
+    "              (default 65536)\n"
+    "  -E          fully parse functions passed to evalcx instead\n"
+    "              of deferring the parsing of their bodies,\n"
+    "              experimental, see make bench\n"
+    "  --warmup N  default number of calls warmup(fun[, n, doc])\n"
+    "              makes to fun so the JIT kicks in before the\n"
+    "              first real document, experimental, see make bench\n"
+    "  --log-slots N\n"
+    "              queue at most N messages passed to log() before\n"
+    "              dropping them, N is rounded up to a power of two\n"
+    "              (default 1024)\n"
+    "  --log-overwrite\n"
+    "              overwrite the oldest queued log message instead\n"
+    "              of dropping the new one when the queue is full\n"
+    "  --log-stderr\n"
+    "              write log messages as plain lines to stderr\n"
+    "              instead of [\"log\", message] lines to stdout\n"
     "  --no-eval   Disable runtime code evaluation\n"
-    "              NOT IMPLEMENTED\n"
+    "  --no-jit    Disable native code generation\n"
+    "  --no-background-jit\n"
+    "              Disable background work like JIT compilation\n"
+    "              and garbage collection on separate threads\n"
     "\n"
     "Report bugs at <%s>.\n";
 
@@ -14,21 +14,38 @@
 #include <stdarg.h>
 #include <stdlib.h>
 #include <string.h>
+#include <math.h>
 
 #include <ChakraCore.h>
 
 #include "couch_args.h"
 #include "couch_readline.h"
 #include "couch_readfile.h"
+#include "couch_modcache.h"
+#include "couch_sendbuf.h"
+#include "couch_strbuf.h"
+#include "couch_reduce.h"
+#include "couch_log.h"
+#include "couch_time.h"
 
 #include "../obj/main.js.h"
+#include "../obj/builtins.js.h"
 
 void beforeCollectFunWithContextCallback(JsRef funInContext, void* callbackState);
+void beforeCollectSerializedScriptCallback(JsRef buffer, void* callbackState);
+bool loadSerializedScript(JsSourceContext sourceContext, JsValueRef* value, JsParseScriptAttributes* parseAttributes);
+JsErrorCode runEager(JsValueRef script, JsValueRef name, JsValueRef* result);
+void warmupFunction(JsValueRef fun, int count, JsValueRef doc);
+void install_builtins(JsValueRef sandbox);
+bool typedArrayValues(JsValueRef values, unsigned char** data, size_t* count, JsTypedArrayType* type);
 
 void create_function(JsValueRef object, char* name, JsNativeFunction fun, void* callbackState);
 JsValueRef normalizeFunction(JsValueRef context, JsValueRef jsNormalizeFunction, JsValueRef funScript);
 void printException(JsErrorCode error);
 void printProperties(JsValueRef object);
+char* js_to_cstring(JsValueRef value);
+JsErrorCode js_stringify(JsValueRef value, JsValueRef* result);
+void set_number_property(JsValueRef object, char* name, double number);
 
 #define JS_FUN_DEF(name) JsValueRef name( \
    JsValueRef callee,                     \
@@ -39,15 +56,37 @@ void printProperties(JsValueRef object);
 
 JS_FUN_DEF(readline);
 JS_FUN_DEF(print);
+JS_FUN_DEF(logMessage);
+JS_FUN_DEF(logStats);
 JS_FUN_DEF(seal);
 JS_FUN_DEF(gc);
 JS_FUN_DEF(quit);
+JS_FUN_DEF(warmup);
+JS_FUN_DEF(now);
 JS_FUN_DEF(evalcx);
 JS_FUN_DEF(runInContext);
+JS_FUN_DEF(moduleCacheGet);
+JS_FUN_DEF(moduleCachePut);
+JS_FUN_DEF(moduleCacheStats);
+JS_FUN_DEF(moduleCacheClear);
+JS_FUN_DEF(send);
+JS_FUN_DEF(flushChunks);
+JS_FUN_DEF(reduceSum);
+JS_FUN_DEF(reduceStats);
 
+//readline([asBuffer]) returns the next line read from stdin, or false on EOF.
+//If `asBuffer` is true the line is returned as an ArrayBuffer backed by a
+//native buffer instead of being copied into a string.
 JS_FUN_DEF(readline)
 {
-  JsValueRef line = couch_readline(stdin);
+  bool asBuffer = false;
+  if(argc > 1) {
+    JsValueRef asBufferValue;
+    JsConvertValueToBoolean(argv[1], &asBufferValue);
+    JsBooleanToBool(asBufferValue, &asBuffer);
+  }
+
+  JsValueRef line = asBuffer ? couch_readline_buffer(stdin) : couch_readline(stdin);
   if(!line) {
     JsValueRef falseValue;
     JsGetFalseValue(&falseValue);
@@ -59,8 +98,13 @@ JS_FUN_DEF(readline)
 
 JS_FUN_DEF(print)
 {
+  //Kept across calls so we don't allocate for every line.
+  static couch_strbuf line = {NULL, 0, 0};
+
   JsValueRef trueValue;
   JsGetTrueValue(&trueValue);
+
+  couch_strbuf_reset(&line);
   
   for(int a = 0; a < argc; a++){
     JsValueRef value = argv[a];
@@ -69,7 +113,7 @@ JS_FUN_DEF(print)
    
 
     if(value == JS_INVALID_REFERENCE) {
-      return trueValue;
+      break;
     }
 
     JsValueType type;
@@ -84,18 +128,155 @@ JS_FUN_DEF(print)
       continue;
     } 
 
-    char *str = malloc(bufferSize + 1);
-    JsCopyString(value, str, bufferSize, &written);
-    str[bufferSize] = 0;
-    fprintf(stdout, "%s", str);
-    free(str);
+    if(!couch_strbuf_reserve(&line, bufferSize)) {
+      break;
+    }
+    JsCopyString(value, line.data + line.used, bufferSize, &written);
+    line.used += written;
   }
-  fputc('\n', stdout);
+  couch_strbuf_append(&line, "\n", 1);
+
+  //A single fwrite keeps the line from interleaving with
+  //log messages written by the log thread
+  fwrite(line.data, 1, line.used, stdout);
   fflush(stdout);
 
   return trueValue;
 }
 
+//log(message) queues `message` for the log thread, non string messages are
+//converted with JSON.stringify. Returns false if the message was dropped.
+JS_FUN_DEF(logMessage)
+{
+  //Kept across calls so we don't allocate for every message.
+  static couch_strbuf scratch = {NULL, 0, 0};
+
+  JsValueRef result;
+  JsGetFalseValue(&result);
+
+  if(argc < 2) {
+    return result;
+  }
+
+  JsValueRef message = argv[1];
+  JsValueType type;
+  JsGetValueType(message, &type);
+
+  if(type != JsString && js_stringify(message, &message) != JsNoError) {
+    return result;
+  }
+
+  size_t bufferSize;
+  size_t written;
+  JsCopyString(message, NULL, 0, &bufferSize);
+  couch_strbuf_reset(&scratch);
+  if(!couch_strbuf_reserve(&scratch, bufferSize)) {
+    return result;
+  }
+  JsCopyString(message, scratch.data, bufferSize, &written);
+
+  if(couch_log_write(scratch.data, written)) {
+    JsGetTrueValue(&result);
+  }
+  return result;
+}
+
+JS_FUN_DEF(logStats)
+{
+  couch_log_stats stats;
+  couch_log_stats_get(&stats);
+
+  JsValueRef result;
+  JsCreateObject(&result);
+  set_number_property(result, "written", stats.written);
+  set_number_property(result, "dropped", stats.dropped);
+  set_number_property(result, "overwritten", stats.overwritten);
+
+  return result;
+}
+
+//send(chunk) appends a chunk to the native send buffer. Nothing is written
+//until flushChunks() is called.
+JS_FUN_DEF(send)
+{
+  //Kept across calls so we don't allocate for every chunk.
+  static couch_strbuf scratch = {NULL, 0, 0};
+
+  JsValueRef result;
+  JsGetTrueValue(&result);
+
+  if(argc < 2) {
+    return result;
+  }
+
+  JsValueRef chunk;
+  size_t bufferSize;
+  size_t written;
+
+  if(JsConvertValueToString(argv[1], &chunk) != JsNoError) {
+    JsGetFalseValue(&result);
+    return result;
+  }
+
+  JsCopyString(chunk, NULL, 0, &bufferSize);
+  if(!couch_strbuf_reserve(&scratch, bufferSize)) {
+    JsGetFalseValue(&result);
+    return result;
+  }
+  JsCopyString(chunk, scratch.data, bufferSize, &written);
+
+  if(!couch_sendbuf_send(scratch.data, written)) {
+    JsGetFalseValue(&result);
+  }
+
+  return result;
+}
+
+//flushChunks([label[, extra]]) writes all chunks collected by send() as a
+//single ["label", [chunks...]] message, label defaults to "chunks". `extra`
+//is appended as third element of the message, e.g. the headers of a
+//["start", chunks, headers] message. It is serialized with JSON.stringify,
+//so a string is written as a JSON string.
+JS_FUN_DEF(flushChunks)
+{
+  JsValueRef result;
+  char* label = NULL;
+  char* extra = NULL;
+
+  if(argc > 1) {
+    label = js_to_cstring(argv[1]);
+  }
+  if(argc > 2) {
+    JsValueRef extraValue = argv[2];
+    JsValueType type;
+    JsGetValueType(extraValue, &type);
+
+    if(type != JsUndefined) {
+      if(js_stringify(extraValue, &extraValue) == JsNoError) {
+        extra = js_to_cstring(extraValue);
+      }
+
+      //JSON.stringify returns undefined for e.g. functions
+      if(extra == NULL || strcmp(extra, "undefined") == 0) {
+        free(label);
+        free(extra);
+        JsGetFalseValue(&result);
+        return result;
+      }
+    }
+  }
+
+  if(couch_sendbuf_flush(stdout, label ? label : "chunks", extra)) {
+    JsGetTrueValue(&result);
+  } else {
+    JsGetFalseValue(&result);
+  }
+
+  free(label);
+  free(extra);
+  return result;
+}
+
 JS_FUN_DEF(seal)
 {
   JsValueRef trueValue;
@@ -129,6 +310,52 @@ JS_FUN_DEF(quit)
   exit(exitCode);
 }
 
+//warmup(fun[, count[, doc]]) calls `fun` `count` times with `doc`, count
+//defaults to the --warmup command line argument if it isn't a number. Without `doc` a synthetic
+//{_id, _rev} document is used, which skips most branches of a typical map
+//function, so pass a document shaped like the real ones. Meant for map
+//functions only, results they emit during warm-up have to be discarded by
+//the caller. Functions with side effects like list functions must not be
+//warmed up.
+JS_FUN_DEF(warmup)
+{
+  couch_args* args = (couch_args*) callbackState;
+  JsValueRef trueValue;
+  JsGetTrueValue(&trueValue);
+
+  if(argc < 2) {
+    return trueValue;
+  }
+
+  int count = args->warmup;
+  JsValueType countType = JsUndefined;
+  if(argc > 2) {
+    JsGetValueType(argv[2], &countType);
+  }
+  if(countType == JsNumber) {
+    JsNumberToInt(argv[2], &count);
+  }
+
+  JsValueRef doc = JS_INVALID_REFERENCE;
+  if(argc > 3) {
+    doc = argv[3];
+  }
+
+  if(count > 0) {
+    warmupFunction(argv[1], count, doc);
+  }
+  return trueValue;
+}
+
+//now() returns milliseconds from a monotonic clock with sub-millisecond
+//resolution, for timing code. Only differences between calls are meaningful.
+JS_FUN_DEF(now)
+{
+  JsValueRef result;
+  JsDoubleToNumber(couch_time_now(), &result);
+  return result;
+}
+
 typedef struct {
   JsValueRef fun;
   JsContextRef context;
@@ -169,10 +396,199 @@ void beforeCollectFunWithContextCallback(JsRef funInContext, void* callbackState
   free(funWithContext);
 }
 
+//Called by ChakraCore if it needs the source of a script run with
+//JsRunSerialized(), the source context is the script itself.
+bool loadSerializedScript(JsSourceContext sourceContext, JsValueRef* value, JsParseScriptAttributes* parseAttributes)
+{
+  *value = (JsValueRef) sourceContext;
+  *parseAttributes = JsParseScriptAttributeNone;
+  return true;
+}
+
+void beforeCollectSerializedScriptCallback(JsRef buffer, void* callbackState)
+{
+  //The byte code is gone, so is the need for its source.
+  JsRelease((JsValueRef) callbackState, NULL);
+}
+
+//Runs `script` in the current context without deferring the parsing of
+//function bodies. Serializing a script compiles it completely to byte code,
+//which is then run instead of the source.
+JsErrorCode runEager(JsValueRef script, JsValueRef name, JsValueRef* result)
+{
+  JsValueRef buffer;
+  JsErrorCode error = JsSerialize(script, &buffer, JsParseScriptAttributeNone);
+  if(error != JsNoError) {
+    return JsRun(script, JS_SOURCE_CONTEXT_NONE, name, JsParseScriptAttributeNone, result);
+  }
+
+  //The corresponding JsRelease call is done in beforeCollectSerializedScriptCallback()
+  JsAddRef(script, NULL);
+  JsSetObjectBeforeCollectCallback(buffer, script, beforeCollectSerializedScriptCallback);
+
+  return JsRunSerialized(buffer, loadSerializedScript, (JsSourceContext) script, name, result);
+}
+
+//Calls `fun` `count` times with `doc` or, if it is JS_INVALID_REFERENCE,
+//a synthetic document. Stops at the first exception.
+void warmupFunction(JsValueRef fun, int count, JsValueRef doc)
+{
+  JsValueType type;
+  JsGetValueType(fun, &type);
+  if(type != JsFunction) {
+    return;
+  }
+
+  JsValueRef undefined;
+  JsGetUndefinedValue(&undefined);
+
+  if(doc == JS_INVALID_REFERENCE) {
+    JsValueRef value;
+    JsPropertyIdRef propId;
+    JsCreateObject(&doc);
+
+    JsCreateString("warmup", strlen("warmup"), &value);
+    JsCreatePropertyId("_id", strlen("_id"), &propId);
+    JsSetProperty(doc, propId, value, false);
+
+    JsCreateString("1-0", strlen("1-0"), &value);
+    JsCreatePropertyId("_rev", strlen("_rev"), &propId);
+    JsSetProperty(doc, propId, value, false);
+  }
+
+  JsValueRef argv[] = {undefined, doc};
+  JsValueRef result;
+  for(int i = 0; i < count; i++) {
+    if(JsCallFunction(fun, argv, 2, &result) != JsNoError) {
+      JsValueRef exception;
+      JsGetAndClearException(&exception);
+      break;
+    }
+  }
+}
+
+//A script compiled once to byte code, which is then run in every sandbox.
+//If it couldn't be serialized, `buffer` is JS_INVALID_REFERENCE and the
+//source is run instead.
+typedef struct {
+  JsValueRef script;
+  JsValueRef href;
+  JsValueRef buffer;
+} SerializedScript;
+
+//What every sandbox starts with: the native helpers, js/builtins.js and the
+//prelude script. The scripts are only compiled once, but run in each new
+//sandbox, so all functions and objects they create belong to the sandbox's
+//own realm and no state is shared between design docs. This saves parsing
+//and compiling per sandbox, not memory: every sandbox still allocates its
+//own helpers.
+typedef struct {
+  SerializedScript builtins;
+  SerializedScript prelude;
+} SandboxTemplate;
+
+SandboxTemplate* create_sandbox_template(const char* prelude);
+void populate_sandbox(SandboxTemplate* sandboxTemplate, JsValueRef sandbox);
+void free_sandbox_template(SandboxTemplate* sandboxTemplate);
+void serialize_script(JsValueRef script, const char* name, SerializedScript* serialized);
+JsErrorCode run_serialized_script(SerializedScript* serialized);
+
+void serialize_script(JsValueRef script, const char* name, SerializedScript* serialized)
+{
+  serialized->script = script;
+  JsCreateString(name, strlen(name), &serialized->href);
+  if(JsSerialize(script, &serialized->buffer, JsParseScriptAttributeNone) != JsNoError) {
+    serialized->buffer = JS_INVALID_REFERENCE;
+  }
+
+  //The corresponding JsRelease calls are done in free_sandbox_template()
+  JsAddRef(serialized->script, NULL);
+  JsAddRef(serialized->href, NULL);
+  if(serialized->buffer != JS_INVALID_REFERENCE) {
+    JsAddRef(serialized->buffer, NULL);
+  }
+}
+
+//Runs the script in the current context.
+JsErrorCode run_serialized_script(SerializedScript* serialized)
+{
+  JsValueRef result;
+  if(serialized->buffer == JS_INVALID_REFERENCE) {
+    return JsRun(serialized->script, JS_SOURCE_CONTEXT_NONE, serialized->href, JsParseScriptAttributeNone, &result);
+  }
+  return JsRunSerialized(serialized->buffer, loadSerializedScript,
+      (JsSourceContext) serialized->script, serialized->href, &result);
+}
+
+//Has to be called in a context which outlives the template.
+SandboxTemplate* create_sandbox_template(const char* prelude)
+{
+  SandboxTemplate* sandboxTemplate = (SandboxTemplate*) calloc(1, sizeof(SandboxTemplate));
+  if(sandboxTemplate == NULL) {
+    return NULL;
+  }
+
+  JsValueRef builtins;
+  JsCreateString((const char*) obj_builtins_js, obj_builtins_js_len, &builtins);
+  serialize_script(builtins, "builtins.js", &sandboxTemplate->builtins);
+
+  sandboxTemplate->prelude.script = JS_INVALID_REFERENCE;
+  if(prelude) {
+    JsValueRef script = couch_readfile(prelude);
+    if(script) {
+      serialize_script(script, prelude, &sandboxTemplate->prelude);
+    }
+  }
+
+  return sandboxTemplate;
+}
+
+//Has to be called in the context of `sandbox`.
+void populate_sandbox(SandboxTemplate* sandboxTemplate, JsValueRef sandbox)
+{
+  //curently only for debugging purposes  
+  create_function(sandbox, "print", print, NULL);
+  create_function(sandbox, "log", logMessage, NULL);
+
+  install_builtins(sandbox);
+  JsErrorCode error = run_serialized_script(&sandboxTemplate->builtins);
+  if(error != JsNoError) {
+    printException(error);
+  }
+
+  if(sandboxTemplate->prelude.script != JS_INVALID_REFERENCE) {
+    error = run_serialized_script(&sandboxTemplate->prelude);
+    if(error != JsNoError) {
+      printException(error);
+    }
+  }
+}
+
+void free_sandbox_template(SandboxTemplate* sandboxTemplate)
+{
+  if(sandboxTemplate == NULL) {
+    return;
+  }
+
+  SerializedScript* scripts[] = {&sandboxTemplate->builtins, &sandboxTemplate->prelude};
+  for(size_t i = 0; i < sizeof(scripts) / sizeof(scripts[0]); i++) {
+    if(scripts[i]->script == JS_INVALID_REFERENCE) {
+      continue;
+    }
+    JsRelease(scripts[i]->script, NULL);
+    JsRelease(scripts[i]->href, NULL);
+    if(scripts[i]->buffer != JS_INVALID_REFERENCE) {
+      JsRelease(scripts[i]->buffer, NULL);
+    }
+  }
+  free(sandboxTemplate);
+}
+
 typedef struct {
   couch_args* args;
   JsRuntimeHandle runtime;
   JsValueRef normalizeFunction;
+  SandboxTemplate* sandboxTemplate;
 } EvalCxContext; 
 
 JS_FUN_DEF(evalcx)
@@ -217,8 +633,7 @@ JS_FUN_DEF(evalcx)
 
      JsSetCurrentContext(context);
      JsGetGlobalObject(&sandbox);
-     //curently only for debugging purposes  
-     create_function(sandbox, "print", print, NULL);
+     populate_sandbox(evalCxContext->sandboxTemplate, sandbox);
      JsSetCurrentContext(oldContext);
   } else {
     JsGetContextOfObject(sandbox, &context);
@@ -243,7 +658,33 @@ JS_FUN_DEF(evalcx)
   
   JsSetCurrentContext(context);
   JsValueRef fun;
-  JsRun(script, JS_SOURCE_CONTEXT_NONE, name, JsParseScriptAttributeNone, &fun);
+  JsErrorCode error;
+  if(evalCxContext->args->eager) {
+    error = runEager(script, name, &fun);
+  } else {
+    error = JsRun(script, JS_SOURCE_CONTEXT_NONE, name, JsParseScriptAttributeNone, &fun);
+  }
+
+  if(error != JsNoError) {
+    //rethrow e.g. syntax errors to the caller of evalcx
+    JsValueRef exception = JS_INVALID_REFERENCE;
+    bool hasException = false;
+    JsHasException(&hasException);
+    if(hasException) {
+      JsGetAndClearException(&exception);
+    }
+    JsSetCurrentContext(oldContext);
+
+    if(exception != JS_INVALID_REFERENCE) {
+      JsSetException(exception);
+    } else {
+      printException(error);
+    }
+
+    JsValueRef undefined;
+    JsGetUndefinedValue(&undefined);
+    return undefined;
+  }
   
   //We need to increase the reference count if the function
   //otherwise it gets garbage collected at some point.
@@ -274,6 +715,174 @@ JS_FUN_DEF(evalcx)
   return funInContext;
 }
 
+//moduleCacheGet(sandbox, ddocId, ddocRev, path) returns the cached exports
+//of a CommonJS module or undefined if the module has not been evaluated yet
+//in `sandbox` for this revision of the design doc.
+JS_FUN_DEF(moduleCacheGet)
+{
+  JsValueRef undefined;
+  JsGetUndefinedValue(&undefined);
+
+  JsContextRef context;
+  if(argc < 5 || JsGetContextOfObject(argv[1], &context) != JsNoError) {
+    return undefined;
+  }
+
+  char* id = js_to_cstring(argv[2]);
+  char* rev = js_to_cstring(argv[3]);
+  char* path = js_to_cstring(argv[4]);
+  JsValueRef exports = JS_INVALID_REFERENCE;
+
+  if(id && rev && path) {
+    exports = couch_modcache_get(context, id, rev, path);
+  }
+
+  free(id);
+  free(rev);
+  free(path);
+
+  return exports == JS_INVALID_REFERENCE ? undefined : exports;
+}
+
+//moduleCachePut(sandbox, ddocId, ddocRev, path, exports) stores the exports
+//of a CommonJS module evaluated in `sandbox`.
+JS_FUN_DEF(moduleCachePut)
+{
+  JsValueRef result;
+  JsGetFalseValue(&result);
+
+  JsContextRef context;
+  if(argc < 6 || JsGetContextOfObject(argv[1], &context) != JsNoError) {
+    return result;
+  }
+
+  //exports from another sandbox would be handed out across realms
+  JsContextRef exportsContext;
+  if(JsGetContextOfObject(argv[5], &exportsContext) == JsNoError
+      && exportsContext != context) {
+    return result;
+  }
+
+  char* id = js_to_cstring(argv[2]);
+  char* rev = js_to_cstring(argv[3]);
+  char* path = js_to_cstring(argv[4]);
+
+  if(id && rev && path) {
+    couch_modcache_put(context, id, rev, path, argv[5]);
+    JsGetTrueValue(&result);
+  }
+
+  free(id);
+  free(rev);
+  free(path);
+
+  return result;
+}
+
+JS_FUN_DEF(moduleCacheStats)
+{
+  couch_modcache_stats stats;
+  couch_modcache_stats_get(&stats);
+
+  size_t lookups = stats.hits + stats.misses;
+  JsValueRef result;
+  JsCreateObject(&result);
+  set_number_property(result, "size", stats.size);
+  set_number_property(result, "hits", stats.hits);
+  set_number_property(result, "misses", stats.misses);
+  set_number_property(result, "hitRate", lookups ? (double) stats.hits / lookups : 0);
+
+  return result;
+}
+
+//moduleCacheClear() drops all cached modules, e.g. on reset, so their
+//sandboxes can be garbage collected.
+JS_FUN_DEF(moduleCacheClear)
+{
+  JsValueRef trueValue;
+  JsGetTrueValue(&trueValue);
+
+  couch_modcache_clear();
+  return trueValue;
+}
+
+//The native reduce builtins only handle typed arrays and return undefined
+//for anything else. js/builtins.js only calls them for typed arrays, plain
+//arrays stay in the JIT compiled JavaScript, going through JSRT for every
+//element is slower than that.
+bool typedArrayValues(JsValueRef values, unsigned char** data, size_t* count, JsTypedArrayType* type)
+{
+  JsValueType valueType;
+  unsigned int bufferLength;
+  int elementSize;
+
+  JsGetValueType(values, &valueType);
+  if(valueType != JsTypedArray) {
+    return false;
+  }
+
+  if(JsGetTypedArrayStorage(values, data, &bufferLength, type, &elementSize) != JsNoError) {
+    return false;
+  }
+  *count = bufferLength / elementSize;
+  return true;
+}
+
+JS_FUN_DEF(reduceSum)
+{
+  JsValueRef result;
+  JsGetUndefinedValue(&result);
+
+  if(argc > 1) {
+    unsigned char* data;
+    size_t count;
+    JsTypedArrayType type;
+    double total;
+
+    if(typedArrayValues(argv[1], &data, &count, &type)
+        && couch_reduce_sum_typed(data, count, type, &total)) {
+      JsDoubleToNumber(total, &result);
+    }
+  }
+
+  return result;
+}
+
+JS_FUN_DEF(reduceStats)
+{
+  JsValueRef result;
+  JsGetUndefinedValue(&result);
+
+  if(argc > 1) {
+    unsigned char* data;
+    size_t count;
+    JsTypedArrayType type;
+    couch_reduce_stats stats = {0, 0, 0, 0, 0};
+
+    //Empty input and NaN values are left to the JavaScript version
+    if(typedArrayValues(argv[1], &data, &count, &type)
+        && couch_reduce_stats_typed(data, count, type, &stats)
+        && stats.count > 0 && !isnan(stats.sum)) {
+      JsCreateObject(&result);
+      set_number_property(result, "sum", stats.sum);
+      set_number_property(result, "count", stats.count);
+      set_number_property(result, "min", stats.min);
+      set_number_property(result, "max", stats.max);
+      set_number_property(result, "sumsqr", stats.sumsqr);
+    }
+  }
+
+  return result;
+}
+
+//Installs the natives js/builtins.js picks up, has to be called before it
+//is run in the context of `sandbox`.
+void install_builtins(JsValueRef sandbox)
+{
+  create_function(sandbox, "reduceSum", reduceSum, NULL);
+  create_function(sandbox, "reduceStats", reduceStats, NULL);
+}
+
 void create_function(JsValueRef object, char* name, JsNativeFunction fun, void* callbackState)
 {
   JsValueRef funHandle;
@@ -285,6 +894,63 @@ void create_function(JsValueRef object, char* name, JsNativeFunction fun, void*
   JsSetProperty(object, propId, funHandle, false);
 }
 
+void set_number_property(JsValueRef object, char* name, double number)
+{
+  JsValueRef value;
+  JsDoubleToNumber(number, &value);
+
+  JsPropertyIdRef propId;
+  JsCreatePropertyId(name, strlen(name), &propId);
+
+  JsSetProperty(object, propId, value, false);
+}
+
+//Returns a NUL terminated copy of the string value of `value`, which has to be
+//freed by the caller. Returns NULL if `value` can't be converted to a string.
+char* js_to_cstring(JsValueRef value)
+{
+  JsValueRef strValue;
+  size_t bufferSize;
+  size_t written;
+
+  if(JsConvertValueToString(value, &strValue) != JsNoError) {
+    return NULL;
+  }
+
+  JsCopyString(strValue, NULL, 0, &bufferSize);
+  char *str = malloc(bufferSize + 1);
+  if(str == NULL) {
+    return NULL;
+  }
+  JsCopyString(strValue, str, bufferSize, &written);
+  str[written] = 0;
+  return str;
+}
+
+//Serializes `value` with JSON.stringify of the current context into a
+//string value.
+JsErrorCode js_stringify(JsValueRef value, JsValueRef* result)
+{
+  JsValueRef global;
+  JsValueRef json;
+  JsValueRef stringify;
+  JsPropertyIdRef propId;
+  JsErrorCode error;
+
+  JsGetGlobalObject(&global);
+  JsCreatePropertyId("JSON", strlen("JSON"), &propId);
+  JsGetProperty(global, propId, &json);
+  JsCreatePropertyId("stringify", strlen("stringify"), &propId);
+  JsGetProperty(json, propId, &stringify);
+
+  JsValueRef argv[] = {json, value};
+  error = JsCallFunction(stringify, argv, 2, result);
+  if(error != JsNoError) {
+    return error;
+  }
+  return JsConvertValueToString(*result, result);
+}
+
 void printProperties(JsValueRef object)
 {
   JsValueRef propertyNames = JS_INVALID_REFERENCE;
@@ -364,7 +1030,32 @@ int main(int argc, const char* argv[])
 
     couch_args* args = couch_parse_args(argc, argv);
     
-    JsCreateRuntime(JsRuntimeAttributeNone, NULL, &runtime);
+    int attributes = JsRuntimeAttributeNone;
+    if(args->no_eval) {
+      attributes |= JsRuntimeAttributeDisableEval;
+    }
+    if(args->no_jit) {
+      attributes |= JsRuntimeAttributeDisableNativeCodeGeneration;
+    }
+    if(args->no_background_jit) {
+      attributes |= JsRuntimeAttributeDisableBackgroundWork;
+    }
+    JsCreateRuntime((JsRuntimeAttributes) attributes, NULL, &runtime);
+
+    couch_modcache_init(args->module_cache_size);
+    couch_sendbuf_init(args->chunk_size);
+
+    int logFlags = 0;
+    if(args->log_overwrite) {
+      logFlags |= COUCH_LOG_OVERWRITE;
+    }
+    if(args->log_stderr) {
+      logFlags |= COUCH_LOG_RAW;
+    }
+    if(!couch_log_init(args->log_stderr ? stderr : stdout, args->log_slots, logFlags)) {
+      fprintf(stderr, "Failed to start the log thread.\n");
+      return 1;
+    }
 
     if(args->stack_size > 0) {
       JsSetRuntimeMemoryLimit(runtime, args->stack_size);  
@@ -380,6 +1071,11 @@ int main(int argc, const char* argv[])
     EvalCxContext *evalCxContext = (EvalCxContext*) malloc(sizeof(EvalCxContext));
     evalCxContext->args = args;
     evalCxContext->runtime = runtime;
+    evalCxContext->sandboxTemplate = create_sandbox_template(args->prelude);
+    if(evalCxContext->sandboxTemplate == NULL) {
+      fprintf(stderr, "Out of memory.\n");
+      return 1;
+    }
 
     create_function(globalObject, "readline", readline, NULL);
     create_function(globalObject, "print", print, NULL);
@@ -387,6 +1083,16 @@ int main(int argc, const char* argv[])
     create_function(globalObject, "gc", gc, runtime);
     create_function(globalObject, "exit", quit, NULL);
     create_function(globalObject, "evalcx", evalcx, evalCxContext);
+    create_function(globalObject, "warmup", warmup, args);
+    create_function(globalObject, "now", now, NULL);
+    create_function(globalObject, "moduleCacheGet", moduleCacheGet, NULL);
+    create_function(globalObject, "moduleCachePut", moduleCachePut, NULL);
+    create_function(globalObject, "moduleCacheStats", moduleCacheStats, NULL);
+    create_function(globalObject, "moduleCacheClear", moduleCacheClear, NULL);
+    create_function(globalObject, "log", logMessage, NULL);
+    create_function(globalObject, "logStats", logStats, NULL);
+    create_function(globalObject, "send", send, NULL);
+    create_function(globalObject, "flushChunks", flushChunks, NULL);
 
     if(evalCxContext->args->use_legacy) {
       JsValueRef mainSrc;
@@ -421,6 +1127,10 @@ int main(int argc, const char* argv[])
       } 
     }
    
+    couch_modcache_clear();
+    couch_sendbuf_free();
+    couch_log_shutdown();
+    free_sandbox_template(evalCxContext->sandboxTemplate);
     free(evalCxContext); 
     JsSetCurrentContext(JS_INVALID_REFERENCE);
     JsDisposeRuntime(runtime);
@@ -0,0 +1,65 @@
+// Times the first documents seen by freshly compiled map functions.
+// Run through warmup.sh, which compares the -E and --warmup flags.
+
+var RUNS = 50;
+var DOCS = [1, 10, 100, 1000];
+
+var docs = [];
+for(var i = 0; i < DOCS[DOCS.length - 1]; i++) {
+  docs.push({
+    _id: "doc" + i,
+    _rev: "1-" + i,
+    type: i % 2 ? "post" : "comment",
+    tags: ["couchdb", "chakra", "tag" + (i % 10)],
+    value: i
+  });
+}
+
+//one document per branch of the map function, so warm-up runs the same
+//code as the real documents
+var warmupDocs = [
+  {_id: "warmup-post", _rev: "1-0", type: "post", tags: ["warmup"], value: 0},
+  {_id: "warmup-comment", _rev: "1-0", type: "comment", value: 0}
+];
+
+//every run compiles a different function so nothing is shared between runs
+var source = '(doc) => {\n' +
+  '  var run = RUN;\n' +
+  '  if(doc.type == "post" && doc.tags) {\n' +
+  '    for(var i = 0; i < doc.tags.length; i++) {\n' +
+  '      emit([doc.tags[i], doc.value], {id: doc._id, run: run});\n' +
+  '    }\n' +
+  '  } else if(doc.type == "comment") {\n' +
+  '    emit(doc._id.toUpperCase(), doc.value * 2);\n' +
+  '  }\n' +
+  '}';
+
+var compile = 0;
+var first = DOCS.map(() => 0);
+
+for(var run = 0; run < RUNS; run++) {
+  var sandbox = evalcx('');
+  evalcx('var results = []; function emit(key, value) { results.push([key, value]); }', sandbox);
+
+  //now() has sub-millisecond resolution, Date.now() would round most of
+  //the first documents down to 0ms
+  var start = now();
+  var fun = evalcx(source.replace("RUN", run), sandbox, "map" + run);
+  warmupDocs.forEach((doc) => warmup(fun, undefined, doc));
+  evalcx('() => { results = []; }', sandbox)();
+  compile += now() - start;
+
+  start = now();
+  for(var b = 0, d = 0; b < DOCS.length; b++) {
+    for(; d < DOCS[b]; d++) {
+      fun(docs[d]);
+    }
+    first[b] += now() - start;
+  }
+}
+
+var report = ["compile+warmup " + (compile / RUNS).toFixed(3) + "ms"];
+for(var b = 0; b < DOCS.length; b++) {
+  report.push("first " + DOCS[b] + " " + (first[b] / RUNS).toFixed(3) + "ms");
+}
+print(report.join(", "));
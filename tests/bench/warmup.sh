@@ -0,0 +1,12 @@
+#!/bin/bash
+# Average latency of the first N documents of a freshly compiled map
+# function, with and without eager compilation and JIT warm-up.
+
+BENCH_DIR=$(dirname $0)
+CHAKRA_BIN=$BENCH_DIR/../../bin/couch-chakra
+WARMUP=${WARMUP:-100}
+
+for flags in "" "-E" "--warmup $WARMUP" "-E --warmup $WARMUP"; do
+  echo -n "${flags:-defaults}: "
+  $CHAKRA_BIN $flags $BENCH_DIR/warmup.js
+done
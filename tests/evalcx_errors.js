@@ -0,0 +1,21 @@
+// -E
+chai.should();
+
+var sandbox = evalcx('');
+
+function thrown(fun) {
+  try {
+    fun();
+  } catch(e) {
+    return e;
+  }
+  return null;
+}
+
+//errors compiling or running the script are thrown to the caller, they
+//belong to the sandbox's realm so check the name instead of instanceof
+thrown(() => evalcx('(doc) => {', sandbox)).name.should.equal("SyntaxError");
+thrown(() => evalcx('throw new Error("boom")', sandbox)).message.should.equal("boom");
+
+//the sandbox is still usable afterwards
+evalcx('(doc) => doc._id', sandbox)({_id: "foo"}).should.equal("foo");
@@ -0,0 +1,19 @@
+// --log-slots 2 --log-stderr
+chai.should();
+
+//empty messages are logged too
+log("").should.equal(true);
+
+//a burst larger than the queue may not fit, how much of it does depends on
+//the writer thread, but every message is either queued or dropped
+var queued = 0;
+for(var i = 0; i < 1000; i++) {
+  if(log("burst " + i)) {
+    queued++;
+  }
+}
+
+var stats = logStats();
+(queued + stats.dropped).should.equal(1000);
+stats.written.should.be.at.most(queued + 1);
+stats.overwritten.should.equal(0);
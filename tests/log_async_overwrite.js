@@ -0,0 +1,12 @@
+// --log-slots 2 --log-stderr --log-overwrite
+chai.should();
+
+//with --log-overwrite new messages replace the oldest queued ones instead
+//of being dropped
+for(var i = 0; i < 1000; i++) {
+  log("burst " + i).should.equal(true);
+}
+
+var stats = logStats();
+stats.dropped.should.equal(0);
+(stats.overwritten + stats.written).should.be.at.most(1000);
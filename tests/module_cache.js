@@ -0,0 +1,63 @@
+chai.should();
+
+var sandbox = evalcx('');
+var evaluations = 0;
+
+function requireCached(ddoc, path, source, target) {
+  target = target || sandbox;
+  var exports = moduleCacheGet(target, ddoc._id, ddoc._rev, path);
+  if(exports === undefined) {
+    evaluations++;
+    var module = evalcx('() => ({exports: {}})', target)();
+    evalcx('(module, exports) => {' + source + '}', target)(module, module.exports);
+    moduleCachePut(target, ddoc._id, ddoc._rev, path, module.exports);
+    exports = module.exports;
+  }
+  return exports;
+}
+
+var ddoc = {_id: "_design/foo", _rev: "1-a"};
+var source = 'exports.answer = () => 42;';
+
+for(var i = 0; i < 1000; i++) {
+  requireCached(ddoc, "lib/answer", source).answer().should.equal(42);
+}
+evaluations.should.equal(1);
+
+var stats = moduleCacheStats();
+stats.size.should.equal(1);
+stats.hits.should.equal(999);
+stats.misses.should.equal(1);
+
+//a new revision of the design doc invalidates its modules
+ddoc._rev = "2-b";
+requireCached(ddoc, "lib/answer", 'exports.answer = () => 43;').answer().should.equal(43);
+evaluations.should.equal(2);
+moduleCacheStats().size.should.equal(1);
+
+//storing more modules of the same revision doesn't drop anything
+requireCached(ddoc, "lib/other", 'exports.other = true;').other.should.equal(true);
+moduleCacheStats().size.should.equal(2);
+requireCached(ddoc, "lib/answer", '').answer().should.equal(43);
+evaluations.should.equal(3);
+
+//another sandbox of the same design doc evaluates its own copy, so module
+//state and realms aren't shared between sandboxes
+var other = evalcx('');
+var counter = 'var n = 0; exports.next = () => ++n; exports.list = [];';
+requireCached(ddoc, "lib/counter", counter).next().should.equal(1);
+requireCached(ddoc, "lib/counter", counter, other).next().should.equal(1);
+requireCached(ddoc, "lib/counter", counter).next().should.equal(2);
+evaluations.should.equal(5);
+evalcx('(list) => list instanceof Array', other)(
+  requireCached(ddoc, "lib/counter", counter, other).list).should.equal(true);
+
+//exports belonging to another sandbox are refused
+moduleCachePut(other, ddoc._id, ddoc._rev, "lib/foreign",
+  requireCached(ddoc, "lib/counter", counter)).should.equal(false);
+
+//e.g. on reset
+moduleCacheClear();
+moduleCacheStats().size.should.equal(0);
+requireCached(ddoc, "lib/answer", 'exports.answer = () => 44;').answer().should.equal(44);
+evaluations.should.equal(6);
@@ -0,0 +1,5 @@
+//Prelude for tests/sandbox_template.js, every sandbox has its own counter.
+var n = 0;
+function next() {
+  return ++n;
+}
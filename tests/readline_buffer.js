@@ -0,0 +1,19 @@
+chai.should();
+
+function decode(buffer) {
+  return String.fromCharCode.apply(null, new Uint8Array(buffer));
+}
+
+//see readline_buffer.in
+var lines = [];
+var line;
+while((line = readline(true)) !== false) {
+  (line instanceof ArrayBuffer).should.equal(true);
+  lines.push(decode(line));
+}
+
+lines.length.should.equal(4);
+lines[0].should.equal('["reset"]');
+lines[1].should.equal('');
+lines[2].length.should.equal(1000);
+lines[3].should.equal('["add_fun", "(doc) => emit(doc._id, null)"]');
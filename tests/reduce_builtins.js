@@ -0,0 +1,53 @@
+chai.should();
+
+var sandbox = evalcx('');
+var run = evalcx('(fun, values, rereduce) => this[fun](values, rereduce)', sandbox);
+
+for(var i = 0; i < 100; i++) {
+  //plain arrays are handled by js/builtins.js
+  run('sum', [1, 2, 3.5, i]).should.equal(6.5 + i);
+  run('count', [1, 2, 3, i]).should.equal(4);
+  run('stats', [4, 1, 9, i]).should.deep.equal({
+    sum: 14 + i,
+    count: 4,
+    min: Math.min(1, i),
+    max: Math.max(9, i),
+    sumsqr: 98 + i * i
+  });
+
+  //typed arrays take the native path
+  run('sum', new Int32Array([1, -2, 3, i])).should.equal(2 + i);
+  run('stats', new Uint16Array([4, 1, 9, i])).should.deep.equal({
+    sum: 14 + i,
+    count: 4,
+    min: Math.min(1, i),
+    max: Math.max(9, i),
+    sumsqr: 98 + i * i
+  });
+  run('sum', new Float64Array([0.1, 0.2, i])).should.equal(0.1 + 0.2 + i);
+  run('count', new Uint8Array(i)).should.equal(i);
+}
+
+//the natives aren't visible in the sandbox
+evalcx('() => typeof reduceSum', sandbox)().should.equal('undefined');
+
+//everything else keeps the semantics of the JavaScript versions
+run('sum', [1, "2", 3]).should.equal("123");
+run('sum', [1, , 3]).should.equal(4);
+//equal() can't tell 0 and -0 apart
+Object.is(run('sum', [-0]), 0).should.equal(true);
+Object.is(run('sum', new Float64Array([-0])), 0).should.equal(true);
+var withExpando = [1, 2];
+withExpando.extra = 3;
+run('sum', withExpando).should.equal(6);
+
+//for typed arrays only the elements count, see js/builtins.js
+var typedWithExpando = new Int32Array([1]);
+typedWithExpando.x = 5;
+run('sum', typedWithExpando).should.equal(1);
+(isNaN(run('stats', new Float64Array([1, NaN])).max)).should.equal(true);
+run('count', [1, 2, 3], true).should.equal(6);
+run('stats', [{sum: 1, count: 1, min: 1, max: 1, sumsqr: 1},
+              {sum: 2, count: 1, min: 2, max: 2, sumsqr: 4}], true).should.deep.equal(
+  {sum: 3, count: 2, min: 1, max: 2, sumsqr: 5});
+(() => run('stats', [1, "a"])).should.throw();
@@ -10,13 +10,31 @@ CHAI_JS=$TESTS_DIR/../obj/chai.js
 for filename in $TESTS_DIR/*.js; do
   
   #extract command line parameters for couch_chakra
+  params=""
   header=$(head -1 $filename)
   if [[ ${header:0:2} == "//" ]] ; then 
     params=${header#"//"}
   fi
 
-  $CHAKRA_BIN -d $params $CHAI_JS "$filename"
-  rc=$?
+  #foo.in is fed to stdin, stdout has to match foo.out
+  input=${filename%.js}.in
+  expected=${filename%.js}.out
+  if [[ ! -f $input ]] ; then
+    input=/dev/null
+  fi
+
+  if [[ -f $expected ]] ; then
+    output=$($CHAKRA_BIN -d $params $CHAI_JS "$filename" < $input)
+    rc=$?
+    if [[ $rc == 0 && "$output" != "$(cat $expected)" ]] ; then
+      echo "$output" | diff $expected -
+      rc=1
+    fi
+  else
+    $CHAKRA_BIN -d $params $CHAI_JS "$filename" < $input
+    rc=$?
+  fi
+
   if [[ $rc != 0 ]]; then
     echo -e "$filename ${RED}failed${NC}." 
   else
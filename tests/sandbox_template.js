@@ -0,0 +1,32 @@
+// --prelude tests/prelude/counter.js
+chai.should();
+
+var sandbox1 = evalcx('');
+var sandbox2 = evalcx('');
+
+//every sandbox gets the helpers and the prelude
+evalcx('() => typeof sum', sandbox1)().should.equal('function');
+evalcx('() => typeof print', sandbox2)().should.equal('function');
+evalcx('() => typeof next', sandbox2)().should.equal('function');
+evalcx('() => sum([1, 2, 3])', sandbox2)().should.equal(6);
+
+//the helpers belong to the sandbox's own realm
+evalcx('() => sum instanceof Function', sandbox1)().should.equal(true);
+evalcx('() => next instanceof Function', sandbox1)().should.equal(true);
+evalcx('() => stats([1, 2]) instanceof Object', sandbox1)().should.equal(true);
+
+//state kept by the prelude isn't shared between sandboxes
+evalcx('() => next()', sandbox1)().should.equal(1);
+evalcx('() => next()', sandbox2)().should.equal(1);
+evalcx('() => next()', sandbox1)().should.equal(2);
+
+//changing a helper doesn't affect other sandboxes
+evalcx('() => { sum.foo = "sandbox1"; Object.prototype.bar = "sandbox1"; }', sandbox1)();
+(evalcx('() => sum.foo', sandbox2)() === undefined).should.equal(true);
+(evalcx('() => ({}).bar', sandbox2)() === undefined).should.equal(true);
+
+//replacing a helper only affects the sandbox itself
+evalcx('() => { sum = () => "sandbox1"; }', sandbox1)();
+evalcx('() => sum()', sandbox1)().should.equal('sandbox1');
+evalcx('() => sum([1])', sandbox2)().should.equal(1);
+evalcx('() => sum([1])', evalcx(''))().should.equal(1);
@@ -0,0 +1,18 @@
+// --chunk-size 4
+chai.should();
+
+//coalesced into chunks of at most 4 bytes, see send_buffer.out
+send("ab").should.equal(true);
+send("cdef");
+send(1);
+flushChunks("start", {headers: {"Content-Type": "text/plain"}}).should.equal(true);
+
+send('"\n');
+flushChunks();
+
+//strings are serialized as JSON strings too
+flushChunks("start", "text/plain");
+flushChunks("end", '{"raw":true}');
+
+//nothing is written for values without a JSON representation
+flushChunks("end", () => 1).should.equal(false);